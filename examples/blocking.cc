@@ -0,0 +1,153 @@
+#include <cstdio>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include "../include/thread_pool.h"
+
+using namespace std;
+using namespace BoboThreadd;
+
+// Sleep stands for a file read or another blocking syscall.
+// Blocking tasks submitted with execute() stall every task queued
+// behind them, execute_blocking() and BlockingRegion avoid it.
+
+class Sleeper : public Task {
+public:
+  Sleeper(ThreadPool* pool, bool region) 
+    : pool_(pool), region_(region), done_(false) { }
+
+  void work() {
+    if ( region_ ) {
+      ThreadPool::BlockingRegion region(pool_);
+      this_thread::sleep_for(chrono::milliseconds(100));
+    } else {
+      this_thread::sleep_for(chrono::milliseconds(100));
+    }
+    done_ = true;
+  }
+
+  bool done() { return done_; }
+
+private:
+  ThreadPool* pool_;
+  bool region_;
+  atomic<bool> done_;
+};
+
+class Counter : public Task {
+public:
+  Counter(atomic<long long>* sum) : sum_(sum), done_(false) { }
+
+  void work() {
+    *sum_ += count();
+    done_ = true;
+  }
+
+  bool done() { return done_; }
+
+  static long long count() {
+    long long x = 0;
+    for (int i = 0; i < 100000; ++i)
+      x += i % 7;
+    return x;
+  }
+
+private:
+  atomic<long long>* sum_;
+  atomic<bool> done_;
+};
+
+// Computes a bit, then enters a blocking call
+class LateSleeper : public Task {
+public:
+  LateSleeper(ThreadPool* pool) : pool_(pool) { }
+
+  void work() {
+    this_thread::sleep_for(chrono::milliseconds(50));
+    ThreadPool::BlockingRegion region(pool_);
+    this_thread::sleep_for(chrono::milliseconds(10));
+  }
+
+private:
+  ThreadPool* pool_;
+};
+
+class Nothing : public Task { };
+
+typedef chrono::high_resolution_clock Clock;
+typedef chrono::duration<double>      Duration;
+
+// mode 0 - execute(), 1 - execute_blocking(), 2 - BlockingRegion
+// Prints when CPU-bound tasks are done and when all the tasks are done
+void measure(const char* name, int mode, int sleepers) {
+  const int counters = 200;
+  const long long expected = counters * Counter::count();
+
+  ThreadPool pool(2, ThreadPool::kConsecutive);
+  atomic<long long> sum(0);
+  vector<Task*> tasks;
+
+  auto tm = Clock::now();
+  pool.start();
+  for (int i = 0; i < sleepers; ++i) {
+    tasks.push_back(new Sleeper(&pool, mode == 2));
+    if ( mode == 1 )
+      pool.execute_blocking(tasks.back());
+    else
+      pool.execute(tasks.back());
+  }
+  for (int i = 0; i < counters; ++i) {
+    tasks.push_back(new Counter(&sum));
+    pool.execute(tasks.back());
+  }
+  while ( sum != expected )
+    this_thread::sleep_for(chrono::milliseconds(1));
+  Duration cpu_sec = chrono::duration_cast<Duration>(Clock::now() - tm);
+  pool.wait();
+  Duration elapsed_sec = chrono::duration_cast<Duration>(Clock::now() - tm);
+
+  // wait() must not return before every task is done,
+  // even if BlockingRegion moved it to another worker
+  bool passed = sum == expected;
+  for (auto task : tasks)
+    passed = passed && task->done();
+
+  for (auto task : tasks)
+    delete task;
+
+  printf("%-18s, %2d blocking : CPU tasks %.3f sec, all %.3f sec\n", 
+    name, sleepers, cpu_sec.count(), elapsed_sec.count());
+  printf( passed ? "TEST PASSED\n" : "TEST FAILED\n" );
+}
+
+// Task queued behind a blocking one is moved to an idle worker
+// while wait() is already waiting
+void handoff() {
+  ThreadPool pool(2, ThreadPool::kConsecutive);
+  LateSleeper late(&pool);
+  Nothing nothing;
+  Sleeper behind(&pool, false);
+
+  pool.start();
+  pool.execute(&late);     // worker 1
+  pool.execute(&nothing);  // worker 0
+  pool.execute(&behind);   // worker 1, after late
+  pool.wait();
+
+  printf("Handoff to another worker\n");
+  printf( behind.done() ? "TEST PASSED\n" : "TEST FAILED\n" );
+}
+
+int main () {
+  handoff();
+  measure("execute()", 0, 20);
+  measure("execute_blocking()", 1, 20);
+  // BlockingRegion helps while some workers aren't blocked
+  measure("execute()", 0, 1);
+  measure("BlockingRegion", 2, 1);
+  // otherwise tasks wait in queues of blocked workers
+  measure("BlockingRegion", 2, 20);
+  return 0;
+}
@@ -0,0 +1,76 @@
+#include <cstdio>
+#include <vector>
+#include <chrono>
+
+#include "../include/thread_pool.h"
+#include "../include/basic_thread_pool.h"
+
+using namespace std;
+using namespace BoboThreadd;
+
+// Tasks doing almost nothing show the cost of the pool itself:
+// dispatching, queueing and calling work()
+
+class Increment : public Task {
+public:
+  Increment() : value(0) { }
+  void work() { ++value; }
+  int value;
+};
+
+// No virtual functions, BasicThreadPool calls work() directly
+struct PlainIncrement {
+  PlainIncrement() : value(0) { }
+  void work() { ++value; }
+  int value;
+};
+
+typedef chrono::high_resolution_clock Clock;
+typedef chrono::duration<double>      Duration;
+
+const int n = 1000*1000, threads = 2;
+
+template<typename Pool, typename TaskType>
+void measure(const char* name, Pool& pool) {
+  vector<TaskType> tasks(n);
+
+  auto tm = Clock::now();
+  for (auto& task : tasks)
+    pool.execute(&task);
+  pool.wait();
+  Duration elapsed_sec = chrono::duration_cast<Duration>(Clock::now() - tm);
+
+  bool passed = true;
+  for (auto& task : tasks)
+    passed = passed && task.value == 1;
+
+  printf("%-40s : %6.1f ns per task\n", name, elapsed_sec.count() * 1e9 / n);
+  printf( passed ? "TEST PASSED\n" : "TEST FAILED\n" );
+}
+
+int main () {
+  {
+    ThreadPool pool(threads, ThreadPool::kConsecutive);
+    pool.start();
+    measure<ThreadPool, Increment>("ThreadPool", pool);
+  }
+  {
+    BasicThreadPool<LockedQueue, ConsecutiveDispatch, 
+                    BlockOnIdle, PlainIncrement> pool(threads);
+    measure<decltype(pool), PlainIncrement>(
+      "BasicThreadPool<LockedQueue>", pool);
+  }
+  {
+    BasicThreadPool<SpinLockedQueue, ConsecutiveDispatch, 
+                    BlockOnIdle, PlainIncrement> pool(threads);
+    measure<decltype(pool), PlainIncrement>(
+      "BasicThreadPool<SpinLockedQueue>", pool);
+  }
+  {
+    BasicThreadPool<SpinLockedQueue, GreedyDispatch, 
+                    BlockOnIdle, PlainIncrement> pool(threads);
+    measure<decltype(pool), PlainIncrement>(
+      "BasicThreadPool<..., GreedyDispatch>", pool);
+  }
+  return 0;
+}
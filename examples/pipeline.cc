@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "../include/pipeline.h"
+
+using namespace std;
+using namespace BoboThreadd;
+
+// read -> parse -> transform -> write
+// Items are allocated by the reader and freed by the writer,
+// so at most "tokens" of them exist at once even for endless input.
+
+struct Item {
+  string text;
+  long long value;
+};
+
+class Reader : public Filter {
+public:
+  Reader(int count) : Filter(kSerialInOrder), count_(count), current_(0) { }
+
+  void* process(void*) {
+    if ( current_ == count_ )
+      return nullptr;
+    Item* item = new Item();
+    item->text = to_string(current_++);
+    return item;
+  }
+
+private:
+  int count_, current_;
+};
+
+class Parser : public Filter {
+public:
+  Parser() : Filter(kParallel) { }
+
+  void* process(void* p) {
+    Item* item = static_cast<Item*>(p);
+    item->value = atoll(item->text.c_str());
+    return item;
+  }
+};
+
+class Transformer : public Filter {
+public:
+  Transformer() : Filter(kParallel) { }
+
+  void* process(void* p) {
+    Item* item = static_cast<Item*>(p);
+    item->value *= item->value;
+    return item;
+  }
+};
+
+class Writer : public Filter {
+public:
+  Writer() : Filter(kSerialInOrder), expected_(0), in_order_(true) { }
+
+  void* process(void* p) {
+    Item* item = static_cast<Item*>(p);
+    if ( item->value != expected_ * expected_ )
+      in_order_ = false;
+    ++expected_;
+    delete item;
+    return nullptr;
+  }
+
+  bool in_order() const { return in_order_; }
+
+private:
+  long long expected_;
+  bool in_order_;
+};
+
+int main () {
+
+  const int n = 200000, tokens = 16;
+
+  typedef chrono::high_resolution_clock Clock;
+  typedef chrono::duration<double>      Duration;
+
+  for (int threads = 1; threads <= 4; threads *= 2) {
+    ThreadPool pool(threads, ThreadPool::kConsecutive);
+    pool.start();
+
+    Reader reader(n);
+    Parser parser;
+    Transformer transformer;
+    Writer writer;
+
+    Pipeline pipeline;
+    pipeline.add_filter(&reader);
+    pipeline.add_filter(&parser);
+    pipeline.add_filter(&transformer);
+    pipeline.add_filter(&writer);
+
+    auto tm = Clock::now();
+    pipeline.run(&pool, tokens);
+    Duration elapsed_sec = chrono::duration_cast<Duration>(Clock::now() - tm);
+
+    printf("Pipeline : %d threads executed in %.3f sec\n",
+      threads, elapsed_sec.count());
+    printf( writer.in_order() ? "TEST PASSED\n" : "TEST FAILED\n" );
+  }
+
+  return 0;
+}
@@ -5,27 +5,44 @@
 #include <chrono>
 
 #include "../include/thread_pool.h"
+#include "../include/combinable.h"
+#include "../include/random.h"
 
 using namespace std;
 using namespace BoboThreadd;
 
+// Array i is generated from stream i of the same seed, so arrays are
+// different, but linear code and ThreadPool produce the same numbers
+const uint64_t kSeed = 2014;
+
+// Every worker reuses its own scratch buffer and accumulates its own sum,
+// so tasks never allocate memory nor wait for each other
 class ArrayGenerator : public Task {
 public:
-  int n, a;
+  int n, a, index;
   bool generated;
-  vector<int>* result;
+  Combinable< vector<int> >* scratch;
+  Combinable<double>* sums;
 
-  ArrayGenerator(int n, int a) : n(n), a(max(a,1)), generated(false) { }
+  ArrayGenerator(int n, int a, int index,
+                 Combinable< vector<int> >* scratch, 
+                 Combinable<double>* sums) 
+    : n(n), a(max(a,1)), index(index), generated(false), 
+      scratch(scratch), sums(sums) { }
 
   void work() {
 
-    std::default_random_engine r;
+    Philox4x32 r(kSeed, index);
     std::uniform_int_distribution<int> rnd(1,a);
 
-    result = new vector<int>();
-    result->reserve(n);
+    vector<int>& result = scratch->local();
+    result.resize(n);
     for (int i = 0; i < n; ++i)
-      result->push_back(rnd(r));
+      result[i] = rnd(r);
+
+    double& sum = sums->local();
+    for (auto num : result)
+      sum += num;
 
     generated = true;
   }
@@ -60,7 +77,7 @@ int main () {
   vector< vector<int>* > lin_arrs;
   lin_arrs.reserve(n);
   for(int i = 0; i < n; ++i) {
-    std::default_random_engine r;
+    Philox4x32 r(kSeed, i);
     std::uniform_int_distribution<int> rnd(1,max(1,a));
 
     // generate arrays in heap
@@ -91,23 +108,22 @@ int main () {
   tm = Clock::now();
 
   ThreadPool pool(2, ThreadPool::kConsecutive); 
+  Combinable< vector<int> > scratch(&pool);
+  Combinable<double> sums(&pool, 0.0);
   
   pool.start();  
   // stack array of pointers
   vector< ArrayGenerator* > pool_arrs; 
   pool_arrs.reserve(n);
-  // generate arrays in heap
   for (int i = 0; i < n; ++i) {    
-    ArrayGenerator* p = new ArrayGenerator(m,a);
+    ArrayGenerator* p = new ArrayGenerator(m, a, i, &scratch, &sums);
     pool_arrs.push_back(p);    
     pool.execute(p);
   }
   pool.wait();
 
-  ev = 0;
-  for (auto arr : pool_arrs)
-    for (auto num : *arr->result)
-      ev += num;
+  // merge per-worker sums instead of walking all the numbers again
+  ev = sums.combine([](double x, double y) { return x + y; });
   ev /= n * m;
 
   for (auto arr : pool_arrs) 
@@ -0,0 +1,121 @@
+#include <cstdio>
+#include <algorithm>
+#include <vector>
+#include <thread>
+
+#include "../include/thread_pool.h"
+#include "../include/random.h"
+
+using namespace std;
+using namespace BoboThreadd;
+
+// Checks Philox4x32 against known answers of the reference implementation
+// and makes sure every fast path gives the same numbers as operator()
+
+const uint64_t kSeed = 2014;
+
+// Returns engine numbers as is, so parallel_generate() output
+// may be compared with parallel_generate_bits()
+struct RawBits {
+  uint32_t operator()(Philox4x32& engine) { return engine(); }
+};
+
+bool known_answers() {
+  const uint32_t counters[3][4] = {
+    { 0, 0, 0, 0 },
+    { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff },
+    { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 } };
+  const uint32_t keys[3][2] = {
+    { 0, 0 },
+    { 0xffffffff, 0xffffffff },
+    { 0xa4093822, 0x299f31d0 } };
+  const uint32_t answers[3][4] = {
+    { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 },
+    { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd },
+    { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } };
+
+  bool ok = true;
+  for (int i = 0; i < 3; ++i) {
+    uint32_t out[4];
+    Philox4x32::block(counters[i], keys[i], out);
+    ok = ok && equal(out, out + 4, answers[i]);
+  }
+  return ok;
+}
+
+// generate(n) after `used` numbers taken by operator(),
+// compared with the same engine called n times
+bool generate_matches(size_t used, size_t n) {
+  Philox4x32 fast(kSeed, 7), slow(kSeed, 7);
+  for (size_t i = 0; i < used; ++i) {
+    fast();
+    slow();
+  }
+  vector<uint32_t> out(n + 1);
+  fast.generate(out.data(), n);
+  // Engine must continue right after the generated numbers
+  out[n] = fast();
+  for (size_t i = 0; i <= n; ++i)
+    if ( out[i] != slow() )
+      return false;
+  return true;
+}
+
+bool discard_matches(size_t used, unsigned long long z) {
+  Philox4x32 fast(kSeed, 3), slow(kSeed, 3);
+  for (size_t i = 0; i < used; ++i) {
+    fast();
+    slow();
+  }
+  fast.discard(z);
+  for (unsigned long long i = 0; i < z; ++i)
+    slow();
+  for (int i = 0; i < 8; ++i)
+    if ( fast() != slow() )
+      return false;
+  return true;
+}
+
+int main () {
+
+  printf( known_answers() ? "TEST PASSED\n" : "TEST FAILED\n" );
+
+  // Batches are 64 numbers long, check around their boundaries
+  const size_t lengths[] = { 0, 1, 3, 4, 5, 63, 64, 65, 127, 128, 129, 1000 };
+  const size_t offsets[] = { 0, 1, 2, 3, 4, 5 };
+  bool generate_ok = true, discard_ok = true;
+  for (size_t used : offsets)
+    for (size_t n : lengths) {
+      generate_ok = generate_ok && generate_matches(used, n);
+      discard_ok = discard_ok && discard_matches(used, n);
+    }
+  printf( generate_ok ? "TEST PASSED\n" : "TEST FAILED\n" );
+  printf( discard_ok ? "TEST PASSED\n" : "TEST FAILED\n" );
+
+  // Result must not depend on count of threads, last chunk is partial
+  const size_t sz = 64 * kRandomChunkSize * 16 + 77;
+  vector<uint32_t> expected(sz);
+  for (size_t i = 0; i < sz; ++i) {
+    Philox4x32 engine(kSeed, i / kRandomChunkSize);
+    engine.discard(i % kRandomChunkSize);
+    expected[i] = engine();
+  }
+
+  size_t max_threads = max(4u, thread::hardware_concurrency());
+  bool parallel_ok = true, bits_ok = true;
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    ThreadPool pool(threads, ThreadPool::kConsecutive);
+    pool.start();
+
+    vector<uint32_t> generated(sz), bits(sz);
+    parallel_generate(&pool, begin(generated), end(generated),
+                      RawBits(), kSeed);
+    parallel_generate_bits(&pool, bits.data(), bits.data() + sz, kSeed);
+    parallel_ok = parallel_ok && generated == expected;
+    bits_ok = bits_ok && bits == expected;
+  }
+  printf( parallel_ok ? "TEST PASSED\n" : "TEST FAILED\n" );
+  printf( bits_ok ? "TEST PASSED\n" : "TEST FAILED\n" );
+
+  return 0;
+}
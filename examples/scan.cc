@@ -0,0 +1,93 @@
+#include <cstdio>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+
+#include "../include/parallel.h"
+
+using namespace std;
+using namespace BoboThreadd;
+
+// Prefix sums, partition and histogram are memory bound,
+// so let's compare them with std:: on a large array
+
+typedef chrono::high_resolution_clock Clock;
+typedef chrono::duration<double>      Duration;
+
+int main () {
+
+  const int sz = 16*1000*1000, bins = 256;
+
+  vector<int> arr(sz);
+  uniform_int_distribution<int> rnd(0, bins - 1);
+  default_random_engine r;
+  for (auto &a : arr) 
+    a = rnd(r);
+
+  size_t threads = max(1u, thread::hardware_concurrency()) - 1;
+  ThreadPool pool(max<size_t>(threads, 1), ThreadPool::kConsecutive);
+  pool.start();
+
+  vector<long long> std_result(sz), pool_result(sz);
+  auto tm = Clock::now();
+  partial_sum(begin(arr), end(arr), begin(std_result), plus<long long>());
+  Duration std_sec = chrono::duration_cast<Duration>(Clock::now() - tm);
+
+  vector<long long> wide(begin(arr), end(arr));
+  tm = Clock::now();
+  parallel_inclusive_scan(&pool, begin(wide), end(wide), begin(pool_result));
+  Duration pool_sec = chrono::duration_cast<Duration>(Clock::now() - tm);
+
+  printf("Inclusive scan : std %.3f sec, pool %.3f sec\n", 
+    std_sec.count(), pool_sec.count());
+  printf( (pool_result == std_result) ? "TEST PASSED\n" : "TEST FAILED\n" );
+
+  parallel_exclusive_scan(&pool, begin(wide), end(wide), 
+                          begin(pool_result), 0LL);
+  bool exclusive_ok = pool_result[0] == 0;
+  for (int i = 1; i < sz; ++i)
+    exclusive_ok = exclusive_ok && pool_result[i] == std_result[i - 1];
+  printf( exclusive_ok ? "TEST PASSED\n" : "TEST FAILED\n" );
+
+  auto odd = [](int x) { return (x & 1) != 0; };
+
+  vector<int> std_part(arr), pool_part(sz);
+  tm = Clock::now();
+  stable_partition(begin(std_part), end(std_part), odd);
+  std_sec = chrono::duration_cast<Duration>(Clock::now() - tm);
+
+  tm = Clock::now();
+  parallel_stable_partition(&pool, begin(arr), end(arr), 
+                            begin(pool_part), odd);
+  pool_sec = chrono::duration_cast<Duration>(Clock::now() - tm);
+
+  printf("Stable partition : std %.3f sec, pool %.3f sec\n", 
+    std_sec.count(), pool_sec.count());
+  printf( (pool_part == std_part) ? "TEST PASSED\n" : "TEST FAILED\n" );
+
+  vector<int> std_odd, pool_odd(sz);
+  copy_if(begin(arr), end(arr), back_inserter(std_odd), odd);
+  pool_odd.resize(parallel_copy_if(&pool, begin(arr), end(arr), 
+                                   begin(pool_odd), odd) - begin(pool_odd));
+  printf( (pool_odd == std_odd) ? "TEST PASSED\n" : "TEST FAILED\n" );
+
+  vector<size_t> std_hist(bins, 0);
+  tm = Clock::now();
+  for (auto a : arr)
+    ++std_hist[a];
+  std_sec = chrono::duration_cast<Duration>(Clock::now() - tm);
+
+  tm = Clock::now();
+  vector<size_t> pool_hist = parallel_histogram(&pool, begin(arr), end(arr), 
+    bins, [](int x) { return static_cast<size_t>(x); });
+  pool_sec = chrono::duration_cast<Duration>(Clock::now() - tm);
+
+  printf("Histogram : linear %.3f sec, pool %.3f sec\n", 
+    std_sec.count(), pool_sec.count());
+  printf( (pool_hist == std_hist) ? "TEST PASSED\n" : "TEST FAILED\n" );
+
+  return 0;
+}
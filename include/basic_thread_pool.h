@@ -0,0 +1,373 @@
+/*
+* Copyright (c) 2014, Zakharov Konstantin
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to 
+* deal in the Software without restriction, including without limitation the 
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+* sell copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in 
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+*/
+
+
+#ifndef BBTHREADD_BASIC_THREADPOOL_H_
+#define BBTHREADD_BASIC_THREADPOOL_H_
+
+#include <cstdint>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <new>
+
+#include "task.h"
+
+namespace BoboThreadd {
+
+// Queue policies
+
+// std::deque guarded by std::mutex
+template<typename T>
+class LockedQueue {
+public:
+  void push(T* item) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    items_.push_back(item);
+  }
+
+  bool try_pop(T*& item) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ( items_.empty() )
+      return false;
+    item = items_.front();
+    items_.pop_front();
+    return true;
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return items_.size();
+  }
+
+private:
+  std::mutex     mutex_;
+  std::deque<T*> items_;
+};
+
+// std::deque guarded by a spin lock: cheaper than LockedQueue,
+// since the queue is held for a few instructions only
+template<typename T>
+class SpinLockedQueue {
+public:
+  SpinLockedQueue() { locked_.clear(); }
+
+  void push(T* item) {
+    lock();
+    items_.push_back(item);
+    unlock();
+  }
+
+  bool try_pop(T*& item) {
+    lock();
+    bool found = !items_.empty();
+    if ( found ) {
+      item = items_.front();
+      items_.pop_front();
+    }
+    unlock();
+    return found;
+  }
+
+  size_t size() {
+    lock();
+    size_t result = items_.size();
+    unlock();
+    return result;
+  }
+
+private:
+  void lock() {
+    while ( locked_.test_and_set(std::memory_order_acquire) )
+      std::this_thread::yield();
+  }
+
+  void unlock() {
+    locked_.clear(std::memory_order_release);
+  }
+
+  std::atomic_flag locked_;
+  std::deque<T*>   items_;
+};
+
+// Dispatch policies
+
+// Workers in order 0,1,..,n-1,0,1,..,n-1 (ThreadPool::kConsecutive)
+class ConsecutiveDispatch {
+public:
+  ConsecutiveDispatch() : next_(0) { }
+
+  template<typename Pool>
+  size_t next(Pool& pool) {
+    return next_.fetch_add(1, std::memory_order_relaxed) % pool.size();
+  }
+
+private:
+  std::atomic<size_t> next_;
+};
+
+// Uniformly distributed worker (ThreadPool::kRandomized)
+class RandomizedDispatch {
+public:
+  template<typename Pool>
+  size_t next(Pool& pool) {
+    // xorshift32, every submitting thread has its own state
+    static thread_local std::uint32_t state = static_cast<std::uint32_t>(
+      std::hash<std::thread::id>()(std::this_thread::get_id())) | 1u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state % pool.size();
+  }
+};
+
+// Worker with the shortest queue (ThreadPool::kGreedy)
+class GreedyDispatch {
+public:
+  template<typename Pool>
+  size_t next(Pool& pool) {
+    size_t best_index = 0;
+    size_t best_size = pool.queue_size(0);
+    for (size_t i = 1, length = pool.size(); i < length && best_size > 0; ++i) {
+      size_t current_size = pool.queue_size(i);
+      if ( current_size < best_size ) {
+        best_size = current_size;
+        best_index = i;
+      }
+    }
+    return best_index;
+  }
+};
+
+// Idle policies
+
+// Sleeps on a condition variable. notify() takes a lock and wakes the
+// worker only once per sleep, pushes to a busy worker cost one atomic
+// increment and a load.
+class BlockOnIdle {
+public:
+  typedef size_t Ticket;
+
+  BlockOnIdle() : epoch_(0), sleeping_(false) { }
+
+  Ticket prepare() {
+    return epoch_.load();
+  }
+
+  void wait(Ticket ticket) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while ( true ) {
+      sleeping_ = true;
+      // notify() either sees sleeping_ or changes epoch_ before this check
+      if ( epoch_.load() != ticket )
+        break;
+      wake_up_.wait(lock);
+    }
+    sleeping_ = false;
+  }
+
+  void notify() {
+    ++epoch_;
+    // Plain load first: busy worker's flag stays in shared cache state
+    if ( sleeping_.load() && sleeping_.exchange(false) ) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      wake_up_.notify_one();
+    }
+  }
+
+private:
+  std::atomic<size_t>     epoch_;
+  std::atomic<bool>       sleeping_;
+  std::mutex              mutex_;
+  std::condition_variable wake_up_;
+};
+
+// Gives up time slice and polls again: lowest latency,
+// but idle workers keep their cores busy
+class YieldOnIdle {
+public:
+  typedef int Ticket;
+
+  Ticket prepare() { return 0; }
+  void wait(Ticket) { std::this_thread::yield(); }
+  void notify() { }
+};
+
+// ThreadPool configured at compile time.
+// ThreadPool chooses dispatch method at runtime, checks worker indexes
+// and calls virtual Task::work(). BasicThreadPool takes all of that as
+// template parameters, so execute() and the worker loop are inlined and
+// TaskType::work() may be a plain non-virtual function:
+//
+//   QueuePolicy<TaskType> - queue of one worker:
+//     void push(TaskType*), bool try_pop(TaskType*&), size_t size()
+//   DispatchPolicy - chooses worker for a task:
+//     template<typename Pool> size_t next(Pool& pool)
+//   IdlePolicy - what a worker does when its queue is empty:
+//     Ticket prepare(), void wait(Ticket), void notify()
+//     ( wait() returns if notify() was called after prepare() )
+//
+// Unlike ThreadPool, threads start in constructor and can't be suspended.
+// Tasks which are still queued at destruction are executed first.
+template<template<typename> class QueuePolicy = LockedQueue,
+         typename DispatchPolicy = ConsecutiveDispatch,
+         typename IdlePolicy = BlockOnIdle,
+         typename TaskType = Task>
+class BasicThreadPool {
+public:
+  typedef TaskType task_type;
+
+  explicit BasicThreadPool(size_t n = 1);
+  ~BasicThreadPool();
+
+  void execute(TaskType* task);  // Submit task for parallel execution
+  size_t size() const { return size_; }
+  size_t queue_size(size_t index) { return slots_[index].queue.size(); }
+
+  // Blocks calling thread until all submitted tasks complete
+  void wait();
+
+private:
+  static const size_t kCacheLineSize = 64;
+
+  // Everything that belongs to one worker, in its own cache lines
+  struct alignas(kCacheLineSize) Slot {
+    QueuePolicy<TaskType> queue;
+    IdlePolicy            idle;
+    std::thread           thread;
+  };
+
+  void working_function(size_t index);
+
+  size_t              size_;
+  Slot*               slots_;
+  // slots_ is allocated inside buffer_ to be cache line aligned
+  char*               buffer_;
+  DispatchPolicy      dispatch_;
+  std::atomic<bool>   canceled_;
+  // Count of submitted tasks that are not finished yet
+  std::atomic<size_t> pending_;
+  std::mutex              done_mutex_;
+  std::condition_variable done_;
+
+  // BasicThreadPool is not copyable
+  BasicThreadPool(const BasicThreadPool&);
+  BasicThreadPool& operator=(const BasicThreadPool&);
+};
+
+// Implementation
+
+template<template<typename> class QueuePolicy, typename DispatchPolicy,
+         typename IdlePolicy, typename TaskType>
+BasicThreadPool<QueuePolicy, DispatchPolicy, IdlePolicy, TaskType>::
+BasicThreadPool(size_t n)
+  : size_(n > 0 ? n : 1),
+    canceled_(false),
+    pending_(0) {
+  // operator new doesn't respect alignas before C++17
+  buffer_ = new char[size_ * sizeof(Slot) + kCacheLineSize];
+  slots_ = reinterpret_cast<Slot*>(buffer_ + (kCacheLineSize - 
+    reinterpret_cast<std::uintptr_t>(buffer_) % kCacheLineSize));
+  for (size_t i = 0; i < size_; ++i)
+    new (&slots_[i]) Slot();
+  size_t started = 0;
+  try {
+    for (; started < size_; ++started)
+      slots_[started].thread = 
+        std::thread(&BasicThreadPool::working_function, this, started);
+  } catch (...) {
+    canceled_ = true;
+    for (size_t i = 0; i < started; ++i) {
+      slots_[i].idle.notify();
+      slots_[i].thread.join();
+    }
+    for (size_t i = 0; i < size_; ++i)
+      slots_[i].~Slot();
+    delete[] buffer_;
+    throw;
+  }
+}
+
+template<template<typename> class QueuePolicy, typename DispatchPolicy,
+         typename IdlePolicy, typename TaskType>
+BasicThreadPool<QueuePolicy, DispatchPolicy, IdlePolicy, TaskType>::
+~BasicThreadPool() {
+  canceled_ = true;
+  for (size_t i = 0; i < size_; ++i)
+    slots_[i].idle.notify();
+  for (size_t i = 0; i < size_; ++i)
+    slots_[i].thread.join();
+  for (size_t i = 0; i < size_; ++i)
+    slots_[i].~Slot();
+  delete[] buffer_;
+}
+
+template<template<typename> class QueuePolicy, typename DispatchPolicy,
+         typename IdlePolicy, typename TaskType>
+void BasicThreadPool<QueuePolicy, DispatchPolicy, IdlePolicy, TaskType>::
+execute(TaskType* task) {
+  pending_.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots_[dispatch_.next(*this)];
+  slot.queue.push(task);
+  slot.idle.notify();
+}
+
+template<template<typename> class QueuePolicy, typename DispatchPolicy,
+         typename IdlePolicy, typename TaskType>
+void BasicThreadPool<QueuePolicy, DispatchPolicy, IdlePolicy, TaskType>::
+wait() {
+  std::unique_lock<std::mutex> lock(done_mutex_);
+  while ( pending_.load() != 0 )
+    done_.wait(lock);
+}
+
+template<template<typename> class QueuePolicy, typename DispatchPolicy,
+         typename IdlePolicy, typename TaskType>
+void BasicThreadPool<QueuePolicy, DispatchPolicy, IdlePolicy, TaskType>::
+working_function(size_t index) {
+  Slot& slot = slots_[index];
+  TaskType* task;
+
+  do {
+    typename IdlePolicy::Ticket ticket = slot.idle.prepare();
+    if ( slot.queue.try_pop(task) ) {
+      task->work();
+      if ( pending_.fetch_sub(1) == 1 ) {
+        // Lock makes sure wait() is either sleeping or sees zero
+        std::lock_guard<std::mutex> lock(done_mutex_);
+        done_.notify_all();
+      }
+    } else if ( !canceled_.load(std::memory_order_relaxed) ) {
+      slot.idle.wait(ticket);
+    } else {
+      break;
+    }
+  } while ( true );
+}
+
+}  // namespace BoboThreadd
+
+#endif  // BBTHREADD_BASIC_THREADPOOL_H_
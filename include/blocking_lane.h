@@ -0,0 +1,82 @@
+/*
+* Copyright (c) 2014, Zakharov Konstantin
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to 
+* deal in the Software without restriction, including without limitation the 
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+* sell copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in 
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+*/
+
+
+#ifndef BBTHREADD_BLOCKING_LANE_H_
+#define BBTHREADD_BLOCKING_LANE_H_
+
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "task.h"
+#include "task_counter.h"
+
+namespace BoboThreadd {
+
+// Executes tasks that spend most of their time in blocking calls
+// (file reads, sockets, sleeps...).
+// Unlike Worker it has no fixed thread: a new detached thread is started
+// whenever all the threads are busy, and threads exit after staying idle
+// for kKeepAlive, so a task never waits behind another blocking one.
+class BlockingLane {
+
+public:
+
+  // Default limit of threads running at once
+  static const size_t kDefaultMaxThreads = 128;
+
+  // counter is notified when a task is finished or interrupted
+  explicit BlockingLane(size_t max_threads = kDefaultMaxThreads,
+                        TaskCounter* counter = nullptr);
+  // Removes queued tasks, blocks until running tasks finish
+  ~BlockingLane();
+
+  void execute(Task*);  // Add task to the queue, start a thread if needed
+  void interrupt();     // Removes all tasks from queue
+  void wait();  // Blocks calling thread until all tasks will be executed
+  size_t size();        // Returns count of running threads
+
+private:
+
+  void working_function();
+
+  size_t              max_threads_;
+  TaskCounter*        counter_;
+  // canceled_ is "true" when BlockingLane is being destroyed
+  bool                canceled_;
+  size_t              threads_;
+  size_t              idle_threads_;
+  size_t              working_threads_;
+  std::queue<Task*>   tasks_;
+  std::mutex          mutex_;
+  // Wakes up idle threads when a task is queued
+  std::condition_variable has_tasks_;
+  // Signals wait() and destructor
+  std::condition_variable state_changed_;
+};
+
+} // namespace BoboThreadd
+
+#endif // BBTHREADD_BLOCKING_LANE_H_
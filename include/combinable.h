@@ -0,0 +1,204 @@
+/*
+* Copyright (c) 2014, Zakharov Konstantin
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to 
+* deal in the Software without restriction, including without limitation the 
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+* sell copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in 
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+*/
+
+
+#ifndef BBTHREADD_COMBINABLE_H_
+#define BBTHREADD_COMBINABLE_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+#include "thread_pool.h"
+
+namespace BoboThreadd {
+
+// Private copy of T for every worker of a ThreadPool.
+// Tasks accumulate into local() without any synchronization, then
+// combine() merges the copies when the tasks are done.
+// Every copy lives in its own cache line and is constructed on
+// first use, so it also may be used as a per-worker scratch buffer.
+template<typename T>
+class Combinable {
+public:
+  // Copies are value-initialized
+  explicit Combinable(ThreadPool* pool);
+  // Copies are copy-constructed from initial
+  Combinable(ThreadPool* pool, const T& initial);
+
+  ~Combinable();
+
+  // Returns copy of calling worker.
+  // Threads not belonging to the pool share a slower, mutex-guarded
+  // table of copies (one per thread)
+  T& local();
+
+  // Returns op(...op(op(copy_0, copy_1), copy_2)..., copy_k)
+  // for all constructed copies, or initial value if there are none
+  // NOTE: must not be called while tasks use local()
+  template<typename BinaryOp>
+  T combine(BinaryOp op);
+
+  // Calls f(copy) for all constructed copies
+  template<typename UnaryFunc>
+  void combine_each(UnaryFunc f);
+
+  // Destroys all copies, next local() will construct them again
+  void clear();
+
+private:
+  static const size_t kCacheLineSize = 64;
+
+  struct Slot {
+    bool constructed;
+    typename std::aligned_storage<sizeof(T),
+                                  std::alignment_of<T>::value>::type value;
+  };
+
+  static_assert(std::alignment_of<Slot>::value <= kCacheLineSize,
+                "Combinable doesn't support over-aligned types");
+
+  // Size of Slot rounded up to cache lines
+  static const size_t kSlotSize = 
+    (sizeof(Slot) + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+
+  void allocate();  // used by constructors
+
+  Slot* slot(size_t index) {
+    return reinterpret_cast<Slot*>(slots_ + index * kSlotSize);
+  }
+
+  ThreadPool* pool_;
+  size_t      count_;
+  T           initial_;
+  // buffer_ is allocated, slots_ is buffer_ aligned to a cache line
+  char*       buffer_;
+  char*       slots_;
+
+  // Copies of threads not belonging to the pool
+  std::map<std::thread::id, T*> foreign_;
+  std::mutex                    foreign_mutex_;
+
+  // Combinable is not copyable
+  Combinable(const Combinable&);
+  Combinable& operator=(const Combinable&);
+};
+
+template<typename T>
+Combinable<T>::Combinable(ThreadPool* pool)
+  : pool_(pool),
+    count_(pool->size()),
+    initial_() {
+  allocate();
+}
+
+template<typename T>
+Combinable<T>::Combinable(ThreadPool* pool, const T& initial)
+  : pool_(pool),
+    count_(pool->size()),
+    initial_(initial) {
+  allocate();
+}
+
+template<typename T>
+void Combinable<T>::allocate() {
+  buffer_ = new char[count_ * kSlotSize + kCacheLineSize];
+  slots_ = buffer_ + (kCacheLineSize - 
+    reinterpret_cast<std::uintptr_t>(buffer_) % kCacheLineSize);
+  for (size_t i = 0; i < count_; ++i)
+    slot(i)->constructed = false;
+}
+
+template<typename T>
+Combinable<T>::~Combinable() {
+  clear();
+  delete[] buffer_;
+}
+
+template<typename T>
+T& Combinable<T>::local() {
+  int index = pool_->worker_index();
+
+  if ( index >= 0 ) {
+    // Only this worker touches its slot, no locks needed
+    Slot* s = slot(index);
+    if ( !s->constructed ) {
+      new (&s->value) T(initial_);
+      s->constructed = true;
+    }
+    return *reinterpret_cast<T*>(&s->value);
+  }
+
+  std::lock_guard<std::mutex> lock(foreign_mutex_);
+  T*& value = foreign_[std::this_thread::get_id()];
+  if ( value == nullptr )
+    value = new T(initial_);
+  return *value;
+}
+
+template<typename T>
+template<typename BinaryOp>
+T Combinable<T>::combine(BinaryOp op) {
+  T result(initial_);
+  bool first = true;
+  combine_each([&](const T& value) {
+    result = first ? value : op(result, value);
+    first = false;
+  });
+  return result;
+}
+
+template<typename T>
+template<typename UnaryFunc>
+void Combinable<T>::combine_each(UnaryFunc f) {
+  for (size_t i = 0; i < count_; ++i)
+    if ( slot(i)->constructed )
+      f(*reinterpret_cast<T*>(&slot(i)->value));
+
+  std::lock_guard<std::mutex> lock(foreign_mutex_);
+  for (auto& item : foreign_)
+    f(*item.second);
+}
+
+template<typename T>
+void Combinable<T>::clear() {
+  for (size_t i = 0; i < count_; ++i) {
+    Slot* s = slot(i);
+    if ( s->constructed ) {
+      reinterpret_cast<T*>(&s->value)->~T();
+      s->constructed = false;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(foreign_mutex_);
+  for (auto& item : foreign_)
+    delete item.second;
+  foreign_.clear();
+}
+
+}  // namespace BoboThreadd
+
+#endif  // BBTHREADD_COMBINABLE_H_
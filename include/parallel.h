@@ -0,0 +1,305 @@
+/*
+* Copyright (c) 2014, Zakharov Konstantin
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to 
+* deal in the Software without restriction, including without limitation the 
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+* sell copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in 
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+*/
+
+
+#ifndef BBTHREADD_PARALLEL_H_
+#define BBTHREADD_PARALLEL_H_
+
+#include <functional>
+#include <iterator>
+#include <vector>
+
+#include "thread_pool.h"
+#include "combinable.h"
+
+namespace BoboThreadd {
+
+// Parallel building blocks working on random access ranges.
+// Range is split into contiguous blocks, one task per block, and the
+// calling thread processes one of the blocks itself.
+// NOTE: pool must be started, functions must not be called by its own tasks
+
+// Ranges are never split into blocks shorter than this
+const size_t kMinBlockSize = 4096;
+
+// Returns count of blocks a range of n items is split into
+// ( at least 1 and never more than n, so blocks are never empty )
+size_t block_count(ThreadPool* pool, size_t n);
+
+// Calls body(0), ..., body(count - 1) in parallel and blocks calling
+// thread until all of them return. If submitting a block or body(0)
+// throws, the exception is rethrown once submitted blocks finish.
+// NOTE: body must not throw on worker threads ( any block but 0 )
+void parallel_blocks(ThreadPool* pool, size_t count,
+                     const std::function<void(size_t)>& body);
+
+// d_first[i] = first[0] op first[1] op ... op first[i]
+// ( op must be associative, d_first may be equal to first )
+template<typename InputIt, typename OutputIt, typename BinaryOp>
+OutputIt parallel_inclusive_scan(ThreadPool* pool,
+                                 InputIt first, InputIt last,
+                                 OutputIt d_first, BinaryOp op);
+
+template<typename InputIt, typename OutputIt>
+OutputIt parallel_inclusive_scan(ThreadPool* pool,
+                                 InputIt first, InputIt last,
+                                 OutputIt d_first);
+
+// d_first[i] = init op first[0] op ... op first[i - 1]
+// ( op must be associative, d_first may be equal to first )
+template<typename InputIt, typename OutputIt, typename T, typename BinaryOp>
+OutputIt parallel_exclusive_scan(ThreadPool* pool,
+                                 InputIt first, InputIt last,
+                                 OutputIt d_first, T init, BinaryOp op);
+
+template<typename InputIt, typename OutputIt, typename T>
+OutputIt parallel_exclusive_scan(ThreadPool* pool,
+                                 InputIt first, InputIt last,
+                                 OutputIt d_first, T init);
+
+// Copies items satisfying pred to d_first keeping their order,
+// returns end of the copied range
+// ( pred is called twice for every item, so it must be pure )
+template<typename InputIt, typename OutputIt, typename UnaryPred>
+OutputIt parallel_copy_if(ThreadPool* pool,
+                          InputIt first, InputIt last,
+                          OutputIt d_first, UnaryPred pred);
+
+// Copies items satisfying pred and then all the others to d_first
+// keeping their order, returns end of the first group
+// ( pred is called twice for every item, so it must be pure )
+template<typename InputIt, typename OutputIt, typename UnaryPred>
+OutputIt parallel_stable_partition(ThreadPool* pool,
+                                   InputIt first, InputIt last,
+                                   OutputIt d_first, UnaryPred pred);
+
+// Returns counts of items for every bin, bin_of(item) must be in [0; bins)
+// ( every worker counts into its own histogram, they are merged at the end )
+template<typename InputIt, typename BinFunc>
+std::vector<size_t> parallel_histogram(ThreadPool* pool,
+                                       InputIt first, InputIt last,
+                                       size_t bins, BinFunc bin_of);
+
+// Implementation
+
+namespace internal {
+
+// Bounds of block index of count blocks covering n items
+inline size_t block_begin(size_t n, size_t count, size_t index) {
+  return n / count * index + (n % count) * index / count;
+}
+
+// Returns count of items satisfying pred before every block
+// ( and the total count as the last element )
+template<typename InputIt, typename UnaryPred>
+std::vector<size_t> match_offsets(ThreadPool* pool, InputIt first,
+                                  size_t n, size_t count, UnaryPred pred) {
+  std::vector<size_t> offsets(count + 1, 0);
+  parallel_blocks(pool, count, [&](size_t block) {
+    size_t begin = block_begin(n, count, block);
+    size_t end = block_begin(n, count, block + 1);
+    size_t matched = 0;
+    for (size_t i = begin; i < end; ++i)
+      matched += pred(first[i]) ? 1 : 0;
+    offsets[block + 1] = matched;
+  });
+
+  for (size_t block = 1; block <= count; ++block)
+    offsets[block] += offsets[block - 1];
+  return offsets;
+}
+
+}  // namespace internal
+
+template<typename InputIt, typename OutputIt, typename T, typename BinaryOp>
+OutputIt parallel_exclusive_scan(ThreadPool* pool,
+                                 InputIt first, InputIt last,
+                                 OutputIt d_first, T init, BinaryOp op) {
+  size_t n = last - first;
+  size_t count = block_count(pool, n);
+
+  // Pass 1: reduce every block (all but the last one are needed)
+  std::vector<T> offsets(count, init);
+  parallel_blocks(pool, count - 1, [&](size_t block) {
+    size_t begin = internal::block_begin(n, count, block);
+    size_t end = internal::block_begin(n, count, block + 1);
+    T sum = first[begin];
+    for (size_t i = begin + 1; i < end; ++i)
+      sum = op(sum, first[i]);
+    offsets[block + 1] = sum;
+  });
+
+  // Turn block sums into block offsets
+  for (size_t block = 1; block < count; ++block)
+    offsets[block] = op(offsets[block - 1], offsets[block]);
+
+  // Pass 2: scan every block starting from its offset
+  parallel_blocks(pool, count, [&](size_t block) {
+    size_t begin = internal::block_begin(n, count, block);
+    size_t end = internal::block_begin(n, count, block + 1);
+    T sum = offsets[block];
+    for (size_t i = begin; i < end; ++i) {
+      T current = first[i];  // first may be equal to d_first
+      d_first[i] = sum;
+      sum = op(sum, current);
+    }
+  });
+
+  return d_first + n;
+}
+
+template<typename InputIt, typename OutputIt, typename T>
+OutputIt parallel_exclusive_scan(ThreadPool* pool,
+                                 InputIt first, InputIt last,
+                                 OutputIt d_first, T init) {
+  return parallel_exclusive_scan(pool, first, last, d_first, init,
+                                 std::plus<T>());
+}
+
+template<typename InputIt, typename OutputIt, typename BinaryOp>
+OutputIt parallel_inclusive_scan(ThreadPool* pool,
+                                 InputIt first, InputIt last,
+                                 OutputIt d_first, BinaryOp op) {
+  typedef typename std::iterator_traits<InputIt>::value_type T;
+
+  size_t n = last - first;
+  if ( n == 0 )
+    return d_first;
+  size_t count = block_count(pool, n);
+
+  // Pass 1: reduce every block but the last one
+  std::vector<T> sums(count);
+  parallel_blocks(pool, count - 1, [&](size_t block) {
+    size_t begin = internal::block_begin(n, count, block);
+    size_t end = internal::block_begin(n, count, block + 1);
+    T sum = first[begin];
+    for (size_t i = begin + 1; i < end; ++i)
+      sum = op(sum, first[i]);
+    sums[block] = sum;
+  });
+
+  // sums[block] becomes the sum of all the items before block + 1
+  for (size_t block = 1; block + 1 < count; ++block)
+    sums[block] = op(sums[block - 1], sums[block]);
+
+  // Pass 2: scan every block starting from the sum of previous ones
+  parallel_blocks(pool, count, [&](size_t block) {
+    size_t begin = internal::block_begin(n, count, block);
+    size_t end = internal::block_begin(n, count, block + 1);
+    T sum = (block == 0) ? first[begin] : op(sums[block - 1], first[begin]);
+    d_first[begin] = sum;
+    for (size_t i = begin + 1; i < end; ++i) {
+      sum = op(sum, first[i]);
+      d_first[i] = sum;
+    }
+  });
+
+  return d_first + n;
+}
+
+template<typename InputIt, typename OutputIt>
+OutputIt parallel_inclusive_scan(ThreadPool* pool,
+                                 InputIt first, InputIt last,
+                                 OutputIt d_first) {
+  typedef typename std::iterator_traits<InputIt>::value_type T;
+  return parallel_inclusive_scan(pool, first, last, d_first, 
+                                 std::plus<T>());
+}
+
+template<typename InputIt, typename OutputIt, typename UnaryPred>
+OutputIt parallel_stable_partition(ThreadPool* pool,
+                                   InputIt first, InputIt last,
+                                   OutputIt d_first, UnaryPred pred) {
+  size_t n = last - first;
+  size_t count = block_count(pool, n);
+
+  std::vector<size_t> offsets = 
+    internal::match_offsets(pool, first, n, count, pred);
+  size_t total = offsets[count];
+
+  // Pass 2: matching items go to the head, the others go to the tail
+  parallel_blocks(pool, count, [&](size_t block) {
+    size_t begin = internal::block_begin(n, count, block);
+    size_t end = internal::block_begin(n, count, block + 1);
+    size_t head = offsets[block];
+    size_t tail = total + (begin - offsets[block]);
+    for (size_t i = begin; i < end; ++i)
+      if ( pred(first[i]) )
+        d_first[head++] = first[i];
+      else
+        d_first[tail++] = first[i];
+  });
+
+  return d_first + total;
+}
+
+template<typename InputIt, typename OutputIt, typename UnaryPred>
+OutputIt parallel_copy_if(ThreadPool* pool,
+                          InputIt first, InputIt last,
+                          OutputIt d_first, UnaryPred pred) {
+  size_t n = last - first;
+  size_t count = block_count(pool, n);
+
+  std::vector<size_t> offsets = 
+    internal::match_offsets(pool, first, n, count, pred);
+
+  // Pass 2: compact matching items of every block
+  parallel_blocks(pool, count, [&](size_t block) {
+    size_t begin = internal::block_begin(n, count, block);
+    size_t end = internal::block_begin(n, count, block + 1);
+    size_t out = offsets[block];
+    for (size_t i = begin; i < end; ++i)
+      if ( pred(first[i]) )
+        d_first[out++] = first[i];
+  });
+
+  return d_first + offsets[count];
+}
+
+template<typename InputIt, typename BinFunc>
+std::vector<size_t> parallel_histogram(ThreadPool* pool,
+                                       InputIt first, InputIt last,
+                                       size_t bins, BinFunc bin_of) {
+  size_t n = last - first;
+  size_t count = block_count(pool, n);
+
+  Combinable< std::vector<size_t> > local(pool, std::vector<size_t>(bins, 0));
+  parallel_blocks(pool, count, [&](size_t block) {
+    size_t begin = internal::block_begin(n, count, block);
+    size_t end = internal::block_begin(n, count, block + 1);
+    size_t* counts = local.local().data();
+    for (size_t i = begin; i < end; ++i)
+      ++counts[bin_of(first[i])];
+  });
+
+  std::vector<size_t> result(bins, 0);
+  local.combine_each([&](const std::vector<size_t>& counts) {
+    for (size_t bin = 0; bin < bins; ++bin)
+      result[bin] += counts[bin];
+  });
+  return result;
+}
+
+}  // namespace BoboThreadd
+
+#endif  // BBTHREADD_PARALLEL_H_
@@ -0,0 +1,112 @@
+/*
+* Copyright (c) 2014, Zakharov Konstantin
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to 
+* deal in the Software without restriction, including without limitation the 
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+* sell copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in 
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+*/
+
+
+#ifndef BBTHREADD_PIPELINE_H_
+#define BBTHREADD_PIPELINE_H_
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include "thread_pool.h"
+
+namespace BoboThreadd {
+
+// One stage of a Pipeline
+class Filter {
+public:
+  // How the stage may be executed by concurrently running items
+  enum Mode {
+    // any number of items are processed at once
+    kParallel = 0,
+    // one item at a time, in the order the input stage produced them
+    kSerialInOrder = 1,
+    // one item at a time, in any order
+    kSerialOutOfOrder = 2
+  };
+
+  explicit Filter(int mode = kParallel) : mode_(mode) { }
+
+  // Filters should never throw in their destructors
+  virtual ~Filter() { }
+
+  // Transforms an item and returns the one passed to the next stage.
+  // The first filter of a pipeline receives nullptr and returns
+  // nullptr when the stream is over. Any other filter may return
+  // nullptr to drop the item.
+  virtual void* process(void* item) = 0;
+
+  int mode() const { return mode_; }
+
+private:
+  int mode_;
+};
+
+// Chain of filters run over a stream of items by a ThreadPool.
+// An item goes through all the stages on the same worker unless it has
+// to wait for its turn at a serial stage.
+class Pipeline {
+public:
+  Pipeline();
+  ~Pipeline();
+
+  // Append a stage (filter is not owned by the pipeline)
+  // NOTE: the first filter is always executed serially
+  void add_filter(Filter* filter);
+
+  // Removes all stages
+  void clear();
+
+  // Blocks calling thread until the input filter runs out of items
+  // and all of them have passed the last stage.
+  // At most max_tokens items are in flight at once.
+  // NOTE: pool must be started, run() must not be called by its own tasks
+  void run(ThreadPool* pool, size_t max_tokens);
+
+private:
+  class Token;
+  struct Stage;
+
+  void run_token(Token* token);   // executed by workers
+  bool advance(Token* token);     // false if token was parked
+  void release_token(Token* token);
+
+  std::vector<Stage*> stages_;
+
+  // State of the current run() call, guarded by mutex_
+  ThreadPool*          pool_;
+  std::vector<Token*>  free_tokens_;
+  size_t               max_tokens_;
+  size_t               in_flight_;
+  size_t               next_seq_;
+  // input_active_ is "true" when some token owns the input stage
+  bool                 input_active_;
+  bool                 end_of_input_;
+  std::mutex           mutex_;
+  std::condition_variable finished_;
+};
+
+}  // namespace BoboThreadd
+
+#endif  // BBTHREADD_PIPELINE_H_
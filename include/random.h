@@ -0,0 +1,127 @@
+/*
+* Copyright (c) 2014, Zakharov Konstantin
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to 
+* deal in the Software without restriction, including without limitation the 
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+* sell copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in 
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+*/
+
+
+#ifndef BBTHREADD_RANDOM_H_
+#define BBTHREADD_RANDOM_H_
+
+#include <cstdint>
+
+#include "parallel.h"
+
+namespace BoboThreadd {
+
+// Counter-based random number engine Philox4x32-10
+// (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+// Output is a pure function of (seed, stream, position), so any task
+// may create its own independent engine without serial seeding, and
+// jumping to any position is O(1).
+// Satisfies UniformRandomBitGenerator, so it works with <random>
+// distributions.
+class Philox4x32 {
+public:
+  typedef std::uint32_t result_type;
+
+  Philox4x32(std::uint64_t seed = 0, std::uint64_t stream = 0);
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return 0xFFFFFFFFu; }
+
+  result_type operator()() {
+    if ( index_ == 4 )
+      refill();
+    return buffer_[index_++];
+  }
+
+  // Restarts the sequence of (seed, stream) from the beginning
+  void seed(std::uint64_t seed, std::uint64_t stream = 0);
+
+  // Skips z numbers
+  void discard(unsigned long long z);
+
+  // Writes next n numbers to out (several times faster than operator())
+  void generate(result_type* out, size_t n);
+
+  // Philox4x32-10 bijection: encrypts counter with key
+  static void block(const result_type counter[4], const result_type key[2],
+                    result_type out[4]);
+
+private:
+  void refill();
+
+  result_type   key_[2];
+  std::uint64_t stream_;
+  // next block to be generated
+  std::uint64_t counter_;
+  // last generated block and count of its numbers already returned
+  result_type   buffer_[4];
+  int           index_;
+};
+
+// Count of items generated by one engine in parallel_generate()
+const size_t kRandomChunkSize = 1024;
+
+// Fills [first; last) with dist(engine) values.
+// Chunk i of kRandomChunkSize items uses Philox4x32(seed, i) and its own
+// copy of dist, so result doesn't depend on count of threads.
+template<typename RandomIt, typename Distribution>
+void parallel_generate(ThreadPool* pool, RandomIt first, RandomIt last,
+                       Distribution dist, std::uint64_t seed);
+
+// Fills [first; last) with raw 32-bit numbers at memory speed.
+// Result is equal to parallel_generate() with a distribution
+// returning engine numbers as is.
+void parallel_generate_bits(ThreadPool* pool, 
+                            std::uint32_t* first, std::uint32_t* last,
+                            std::uint64_t seed);
+
+// Implementation
+
+template<typename RandomIt, typename Distribution>
+void parallel_generate(ThreadPool* pool, RandomIt first, RandomIt last,
+                       Distribution dist, std::uint64_t seed) {
+  size_t n = last - first;
+  size_t chunks = (n + kRandomChunkSize - 1) / kRandomChunkSize;
+  size_t count = block_count(pool, n);
+  if ( count > chunks )
+    count = (chunks > 0) ? chunks : 1;
+
+  parallel_blocks(pool, count, [&](size_t block) {
+    size_t begin = internal::block_begin(chunks, count, block);
+    size_t end = internal::block_begin(chunks, count, block + 1);
+    for (size_t chunk = begin; chunk < end; ++chunk) {
+      Philox4x32 engine(seed, chunk);
+      Distribution chunk_dist(dist);
+      size_t i = chunk * kRandomChunkSize;
+      size_t chunk_end = i + kRandomChunkSize;
+      if ( chunk_end > n )
+        chunk_end = n;
+      for (; i < chunk_end; ++i)
+        first[i] = chunk_dist(engine);
+    }
+  });
+}
+
+}  // namespace BoboThreadd
+
+#endif  // BBTHREADD_RANDOM_H_
@@ -0,0 +1,72 @@
+/*
+* Copyright (c) 2014, Zakharov Konstantin
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to 
+* deal in the Software without restriction, including without limitation the 
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+* sell copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in 
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+*/
+
+
+#ifndef BBTHREADD_TASK_COUNTER_H_
+#define BBTHREADD_TASK_COUNTER_H_
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+namespace BoboThreadd {
+
+// Counts tasks that are submitted but not finished yet,
+// wherever they are queued or executed.
+// add() and done() cost one atomic operation, the mutex is taken only
+// when the count drops to zero.
+class TaskCounter {
+public:
+  TaskCounter() : count_(0) { }
+
+  void add() {
+    count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Called when count tasks are finished or removed from a queue
+  void done(size_t count = 1) {
+    if ( count == 0 )
+      return;
+    if ( count_.fetch_sub(count) == count ) {
+      // Lock makes sure wait() is either sleeping or sees zero
+      std::lock_guard<std::mutex> lock(mutex_);
+      zero_.notify_all();
+    }
+  }
+
+  // Blocks calling thread until count drops to zero
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while ( count_ != 0 )
+      zero_.wait(lock);
+  }
+
+private:
+  std::atomic<size_t>     count_;
+  std::mutex              mutex_;
+  std::condition_variable zero_;
+};
+
+}  // namespace BoboThreadd
+
+#endif  // BBTHREADD_TASK_COUNTER_H_
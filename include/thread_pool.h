@@ -25,18 +25,24 @@
 #define BBTHREADD_THREADPOOL_H_
 
 #include <vector>
+#include <atomic>
 
 #include "worker.h"
+#include "blocking_lane.h"
+#include "task_counter.h"
 #include "task.h"
 
 namespace BoboThreadd {
 
 // Spawns a set of threads that are used to run submitted tasks in parallel
+// ( see BasicThreadPool for the variant configured at compile time )
 class ThreadPool {
 public:
 
   // Create n Workers
   // ( n is number of threads to service tasks with )	
+  // Worker thread is started when the first task is queued to it,
+  // so unused workers cost nothing (see also warm_up())
   ThreadPool(size_t n = 1, int dispatch_type = kConsecutive);
 
   // Destroy all workers (stop threads)
@@ -54,12 +60,32 @@ public:
     kCombination = 3
   };  
   
-  void execute(Task* task); // Submit task for parallel execution
+  void execute(Task* task); // Submit task for parallel execution (thread-safe)
+
+  // Submit task that spends most of its time in blocking calls.
+  // It runs on a separate elastic set of threads (see BlockingLane),
+  // so workers stay busy with CPU-bound tasks meanwhile.
+  // NOTE: suspend() doesn't affect these tasks
+  void execute_blocking(Task* task);
   void start(); // Start executing tasks or cancel suspend()  
+
+  // Starts all worker threads at once and blocks calling thread until
+  // they are running with the top of their stacks already mapped.
+  // Call it before latency-sensitive work to avoid paying for thread
+  // creation on the first tasks.
+  void warm_up();
+
   size_t size(); // Returns count of workers
 
-  // Blocks calling thread until all tasks 
-  // submitted prior to this invocation complete
+  // Returns index of the worker running calling thread,
+  // or -1 if calling thread doesn't belong to this pool
+  int worker_index();
+
+  // Blocks calling thread until the pool-wide pending task count
+  // reaches zero. Tasks submitted while waiting ( by other threads,
+  // by tasks themselves, Pipeline tokens ) are waited for too;
+  // tasks moved between workers or to the lane are counted.
+  // NOTE: interrupt() during Pipeline::run() leaves run() blocked forever
   void wait();
 
   // Makes workers sleeping  
@@ -68,15 +94,37 @@ public:
   // Removes tasks that had been submitted prior to this function invoking.
   // Tasks submitted after the invocation of this function are unaffected.
   void interrupt();  // NOTE: currently running tasks unaffected    
+
+  // Create it inside a task before a blocking call:
+  // while it exists, tasks queued to the calling worker are handed
+  // over to other workers and new tasks bypass it.
+  // If all the workers are blocked, tasks are queued to the one with
+  // the shortest queue. Regions may be nested.
+  // Does nothing if calling thread doesn't belong to the pool.
+  class BlockingRegion {
+  public:
+    explicit BlockingRegion(ThreadPool* pool);
+    ~BlockingRegion();
+  private:
+    Worker* worker_;
+  };
   
 private:
+  // Puts task to a queue without counting it (see execute())
+  void dispatch(Task* task);
+
+  // Tasks submitted to workers and lane but not finished yet
+  TaskCounter pending_;
   // 1 Worker = 1 std::thread + 1 std::queue<Task*> + 1 std::mutex
   std::vector<Worker*> workers_;
+  // Threads for execute_blocking()
+  BlockingLane* lane_;
 
   // TODO: create class "Dispatcher" with method "int next()",
   //       provide an interface allowing user to implement his own dispatcher
   int dispatch_type_;
-  int current_index_;
+  // atomic since tasks may submit tasks from worker threads
+  std::atomic<size_t> current_index_;
 
   int get_consecutive();  // kConsecutive
   int get_randomized();   // kRandomized
@@ -25,45 +25,81 @@
 #define BBTHREADD_WORKER_H_
 
 #include <queue>
+#include <vector>
+#include <atomic>
 #include <thread>
 #include <mutex>
-#include <chrono>
+#include <condition_variable>
 
 #include "task.h"
+#include "task_counter.h"
 
 namespace BoboThreadd {
 
-// Executes tasks in detached thread
+// Executes tasks in its own thread
 // Thread recieving tasks from FIFO
 class Worker {
 
 public:
 
-  Worker();  // Starts detached thread that execute given tasks
-  ~Worker(); // Stops detached thread
+  // Thread is not started until the first task or warm_up()
+  // ( index is position of the worker in its pool,
+  //   counter is notified when a task is finished or interrupted )
+  explicit Worker(size_t index = 0, TaskCounter* counter = nullptr);
+  ~Worker(); // Stops thread, queued tasks are not executed
   
   void execute(Task*);       // Add task to worker queue  
+  void warm_up();            // Starts thread ahead of the first task
+  void wait_started();       // Blocks calling thread until thread starts
   void interrupt();          // Removes all tasks from queue    
   void wait();  // Blocks calling thread until all tasks will be executed
   void start();              // Allows tasks execution  
   void suspend();            // Restricts tasks execution  
   size_t size();             // Returns tasks_ size  
+  size_t index();            // Returns index given to constructor
+
+  // Removes all tasks from queue and returns them
+  std::vector<Task*> release_tasks();
+
+  // Blocked worker is busy with a blocking call, so ThreadPool
+  // doesn't give it new tasks. Calls may be nested, the worker stays
+  // blocked until every block() is matched by unblock().
+  void block();
+  void unblock();
+  bool blocked();
+
+  // Returns Worker running calling thread or nullptr for other threads
+  static Worker* current();
 
 private:
 
-  void working_function();
+  void spawn(bool warm_up);
+  void working_function(bool warm_up);
+
+  // Worker owning calling thread (set by working_function)
+  static thread_local Worker* current_;
+
+  size_t			index_;
+  TaskCounter		*counter_;
 
+  // Flags and tasks_ are guarded by mutex_
   // canceled_ is "true" when Worker should be turned off
   bool				canceled_;
-  // suspended_ is "true" when Worker should sleep(10)
+  // suspended_ is "true" when Worker shouldn't execute tasks
   bool				suspended_;
   // working_ is "true" when Worker executing some task
   bool				working_;
+  // started_ is "true" when thread is running
+  bool				started_;
+  // Count of blocking regions entered by the task being executed
+  std::atomic<int> blocked_;
+  // nullptr until the thread is started
+  std::thread		*thread_;
   std::queue<Task*> *tasks_;	
   // Critical section needed to control thread-unsafe std::queue
   std::mutex		*mutex_;
-  // We need one more mutex to be sure that thread is stopped
-  std::mutex        *global_mutex_;
+  // Signals new tasks, start(), cancellation and empty queue
+  std::condition_variable *state_changed_;
 };
 
 } // namespace BoboThreadd
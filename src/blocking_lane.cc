@@ -0,0 +1,131 @@
+/*
+* Copyright (c) 2014, Zakharov Konstantin
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to 
+* deal in the Software without restriction, including without limitation the 
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+* sell copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in 
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+*/
+
+
+#include "../include/blocking_lane.h"
+#include <thread>
+
+using namespace BoboThreadd;
+
+namespace {
+
+// Idle thread exits after this time
+const std::chrono::milliseconds kKeepAlive(1000);
+
+}  // namespace
+
+BlockingLane::BlockingLane(size_t max_threads, TaskCounter* counter)
+  : max_threads_(max_threads > 0 ? max_threads : 1),
+    counter_(counter),
+    canceled_(false),
+    threads_(0),
+    idle_threads_(0),
+    working_threads_(0) {
+}
+
+BlockingLane::~BlockingLane() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  canceled_ = true;
+  while( !tasks_.empty() )
+    tasks_.pop();
+  has_tasks_.notify_all();
+  while( threads_ != 0 )
+    state_changed_.wait(lock);
+}
+
+void BlockingLane::execute(Task* task) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if( canceled_ )
+    return;
+
+  // Every queued task needs its own thread, otherwise it would wait
+  // for the end of somebody's blocking call
+  if( tasks_.size() + 1 > idle_threads_ && threads_ < max_threads_ ) {
+    // Thread waits for mutex_, so counting it after construction is
+    // safe. If construction throws, nothing is changed.
+    std::thread(&BlockingLane::working_function, this).detach();
+    ++threads_;
+    tasks_.push(task);
+  } else {
+    tasks_.push(task);
+    has_tasks_.notify_one();
+  }
+}
+
+void BlockingLane::interrupt() {
+  size_t removed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    removed = tasks_.size();
+    while( !tasks_.empty() )
+      tasks_.pop();
+    state_changed_.notify_all();
+  }
+
+  if( counter_ != nullptr )
+    counter_->done(removed);
+}
+
+void BlockingLane::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while( !tasks_.empty() || working_threads_ != 0 )
+    state_changed_.wait(lock);
+}
+
+size_t BlockingLane::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return threads_;
+}
+
+void BlockingLane::working_function() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  do {
+    if( tasks_.empty() ) {
+      ++idle_threads_;
+      std::cv_status status = has_tasks_.wait_for(lock, kKeepAlive);
+      --idle_threads_;
+      if( status == std::cv_status::timeout && tasks_.empty() )
+        break;
+    } else {
+      Task* current_task = tasks_.front();
+      tasks_.pop();
+      ++working_threads_;
+      lock.unlock();
+
+      // work() doesn't require synchronization
+      current_task->work();
+      if( counter_ != nullptr )
+        counter_->done();
+
+      lock.lock();
+      --working_threads_;
+      if( tasks_.empty() && working_threads_ == 0 )
+        state_changed_.notify_all();
+    }
+  } while( !canceled_ );
+
+  // Destructor may return as soon as the lock is released
+  --threads_;
+  state_changed_.notify_all();
+}
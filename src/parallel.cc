@@ -0,0 +1,111 @@
+/*
+* Copyright (c) 2014, Zakharov Konstantin
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to 
+* deal in the Software without restriction, including without limitation the 
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+* sell copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in 
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+*/
+
+
+#include "../include/parallel.h"
+#include <mutex>
+#include <condition_variable>
+
+using namespace BoboThreadd;
+
+namespace {
+
+// Counts finished blocks of parallel_blocks()
+class Latch {
+public:
+  explicit Latch(size_t count) : count_(count) { }
+
+  void count_down(size_t n = 1) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    count_ -= n;
+    if ( count_ == 0 )
+      zero_.notify_all();
+  }
+
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while ( count_ != 0 )
+      zero_.wait(lock);
+  }
+
+private:
+  size_t                  count_;
+  std::mutex              mutex_;
+  std::condition_variable zero_;
+};
+
+class BlockTask : public Task {
+public:
+  BlockTask(const std::function<void(size_t)>* body,
+            size_t index,
+            Latch* latch)
+    : body_(body),
+      index_(index),
+      latch_(latch) {
+  }
+
+  virtual void work() {
+    (*body_)(index_);
+    latch_->count_down();
+  }
+
+private:
+  const std::function<void(size_t)>* body_;
+  size_t index_;
+  Latch* latch_;
+};
+
+}  // namespace
+
+size_t BoboThreadd::block_count(ThreadPool* pool, size_t n) {
+  // Calling thread takes one block too
+  size_t count = pool->size() + 1;
+  size_t limit = n / kMinBlockSize;
+  if ( count > limit )
+    count = limit;
+  return count > 0 ? count : 1;
+}
+
+void BoboThreadd::parallel_blocks(ThreadPool* pool, size_t count,
+                                  const std::function<void(size_t)>& body) {
+  if ( count == 0 )
+    return;
+
+  Latch latch(count - 1);
+  std::vector<BlockTask> tasks;
+  tasks.reserve(count - 1);
+  size_t submitted = 1;
+  try {
+    for (; submitted < count; ++submitted) {
+      tasks.push_back(BlockTask(&body, submitted, &latch));
+      pool->execute(&tasks.back());
+    }
+    body(0);
+  } catch (...) {
+    // Submitted tasks still use tasks and latch, let them finish first
+    latch.count_down(count - submitted);
+    latch.wait();
+    throw;
+  }
+  latch.wait();
+}
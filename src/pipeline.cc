@@ -0,0 +1,241 @@
+/*
+* Copyright (c) 2014, Zakharov Konstantin
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to 
+* deal in the Software without restriction, including without limitation the 
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+* sell copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in 
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+*/
+
+
+#include "../include/pipeline.h"
+#include <map>
+
+using namespace BoboThreadd;
+
+// Item travelling through the stages, reused after the last stage
+class Pipeline::Token : public Task {
+public:
+  explicit Token(Pipeline* owner)
+    : owner_(owner),
+      item_(nullptr),
+      seq_(0),
+      stage_(0) {
+  }
+
+  virtual void work() {
+    owner_->run_token(this);
+  }
+
+  Pipeline* owner_;
+  void*     item_;
+  // position of the item in the input stream
+  size_t    seq_;
+  // index of the next stage to run, 0 means "read new item"
+  size_t    stage_;
+};
+
+struct Pipeline::Stage {
+  explicit Stage(Filter* filter)
+    : filter(filter),
+      busy(false),
+      next_seq(0) {
+  }
+
+  Filter* filter;
+  // Guards the fields below (used by serial stages only)
+  std::mutex mutex;
+  // busy is "true" when some token is inside the filter
+  bool busy;
+  // sequence number of the item kSerialInOrder stage is waiting for
+  size_t next_seq;
+  // tokens that came to the stage before their turn
+  std::map<size_t, Token*> parked;
+};
+
+Pipeline::Pipeline()
+  : pool_(nullptr),
+    max_tokens_(0),
+    in_flight_(0),
+    next_seq_(0),
+    input_active_(false),
+    end_of_input_(false) {
+}
+
+Pipeline::~Pipeline() {
+  clear();
+}
+
+void Pipeline::add_filter(Filter* filter) {
+  stages_.push_back(new Stage(filter));
+}
+
+void Pipeline::clear() {
+  for (auto stage : stages_)
+    delete stage;
+  stages_.clear();
+}
+
+void Pipeline::run(ThreadPool* pool, size_t max_tokens) {
+  if ( stages_.empty() || max_tokens == 0 )
+    return;
+
+  for (auto stage : stages_) {
+    stage->busy = false;
+    stage->next_seq = 0;
+    stage->parked.clear();
+  }
+
+  // Tokens are allocated once, so memory usage doesn't depend
+  // on the length of the stream
+  std::vector<Token*> tokens;
+  tokens.reserve(max_tokens);
+  for (size_t i = 0; i < max_tokens; ++i)
+    tokens.push_back(new Token(this));
+
+  Token* first;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pool_ = pool;
+    free_tokens_ = tokens;
+    max_tokens_ = max_tokens;
+    next_seq_ = 0;
+    end_of_input_ = false;
+    input_active_ = true;
+    in_flight_ = 1;
+    first = free_tokens_.back();
+    free_tokens_.pop_back();
+    first->stage_ = 0;
+  }
+  pool->execute(first);
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while ( !end_of_input_ || in_flight_ != 0 )
+      finished_.wait(lock);
+    free_tokens_.clear();
+    pool_ = nullptr;
+  }
+
+  for (auto token : tokens)
+    delete token;
+}
+
+void Pipeline::run_token(Token* token) {
+  do {
+    if ( token->stage_ == 0 ) {
+      // Only one token at a time owns the input stage (see input_active_)
+      void* item = stages_[0]->filter->process(nullptr);
+
+      Token* reader = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if ( item == nullptr ) {
+          end_of_input_ = true;
+          input_active_ = false;
+          release_token(token);
+          return;
+        }
+        token->item_ = item;
+        token->seq_ = next_seq_++;
+        token->stage_ = 1;
+
+        // Hand the input stage over to another token if there is a free
+        // one, otherwise it will be taken by the first token to finish
+        if ( in_flight_ < max_tokens_ ) {
+          reader = free_tokens_.back();
+          free_tokens_.pop_back();
+          reader->stage_ = 0;
+          ++in_flight_;
+        } else {
+          input_active_ = false;
+        }
+      }
+      if ( reader != nullptr )
+        pool_->execute(reader);
+    }
+
+    // Item stays on this worker (and in its cache) until it is parked
+    if ( !advance(token) )
+      return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ( end_of_input_ || input_active_ ) {
+      release_token(token);
+      return;
+    }
+    input_active_ = true;
+    token->stage_ = 0;
+  } while ( true );
+}
+
+bool Pipeline::advance(Token* token) {
+  for (size_t i = token->stage_, length = stages_.size(); i < length; ++i) {
+    Stage* stage = stages_[i];
+    int mode = stage->filter->mode();
+
+    if ( mode != Filter::kParallel ) {
+      std::lock_guard<std::mutex> lock(stage->mutex);
+      if ( stage->busy || 
+           (mode == Filter::kSerialInOrder && 
+            token->seq_ != stage->next_seq) ) {
+        // Whoever leaves the stage will resubmit the token
+        token->stage_ = i;
+        stage->parked[token->seq_] = token;
+        return false;
+      }
+      stage->busy = true;
+    }
+
+    // Dropped items still pass serial stages to keep the order
+    if ( token->item_ != nullptr )
+      token->item_ = stage->filter->process(token->item_);
+
+    if ( mode != Filter::kParallel ) {
+      Token* resumed = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(stage->mutex);
+        stage->busy = false;
+        ++stage->next_seq;
+
+        auto it = stage->parked.end();
+        if ( mode == Filter::kSerialInOrder )
+          it = stage->parked.find(stage->next_seq);
+        else
+          it = stage->parked.begin();
+
+        if ( it != stage->parked.end() ) {
+          resumed = it->second;
+          stage->parked.erase(it);
+        }
+      }
+      if ( resumed != nullptr )
+        pool_->execute(resumed);
+    }
+  }
+
+  token->item_ = nullptr;
+  return true;
+}
+
+// NOTE: mutex_ must be locked by the caller
+void Pipeline::release_token(Token* token) {
+  free_tokens_.push_back(token);
+  --in_flight_;
+  if ( end_of_input_ && in_flight_ == 0 )
+    finished_.notify_all();
+}
@@ -0,0 +1,190 @@
+/*
+* Copyright (c) 2014, Zakharov Konstantin
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to 
+* deal in the Software without restriction, including without limitation the 
+* rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+* sell copies of the Software, and to permit persons to whom the Software is 
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in 
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+*/
+
+
+#include "../include/random.h"
+
+using namespace BoboThreadd;
+
+namespace {
+
+const std::uint32_t kMultiplier0 = 0xD2511F53u;
+const std::uint32_t kMultiplier1 = 0xCD9E8D57u;
+const std::uint32_t kWeyl0 = 0x9E3779B9u;
+const std::uint32_t kWeyl1 = 0xBB67AE85u;
+const int kRounds = 10;
+
+// Blocks encrypted at once by generate(): rounds are applied to all of
+// them in independent plain loops, which compilers turn into SIMD code
+const size_t kBatchSize = 16;
+
+std::uint32_t low(std::uint64_t x) {
+  return static_cast<std::uint32_t>(x);
+}
+
+std::uint32_t high(std::uint64_t x) {
+  return static_cast<std::uint32_t>(x >> 32);
+}
+
+// Encrypts kBatchSize consecutive counters starting at counter,
+// out receives 4 * kBatchSize numbers in sequence order
+void batch(std::uint64_t counter, std::uint64_t stream,
+           const std::uint32_t key[2], std::uint32_t* out) {
+  std::uint32_t k0[kRounds], k1[kRounds];
+  k0[0] = key[0];
+  k1[0] = key[1];
+  for (int round = 1; round < kRounds; ++round) {
+    k0[round] = k0[round - 1] + kWeyl0;
+    k1[round] = k1[round - 1] + kWeyl1;
+  }
+
+  // Every block is independent, so the loop over blocks is vectorized
+  // (rounds are unrolled inside it)
+  std::uint32_t r0[kBatchSize], r1[kBatchSize];
+  std::uint32_t r2[kBatchSize], r3[kBatchSize];
+  for (size_t i = 0; i < kBatchSize; ++i) {
+    std::uint32_t c0 = low(counter + i), c1 = high(counter + i);
+    std::uint32_t c2 = low(stream), c3 = high(stream);
+    for (int round = 0; round < kRounds; ++round) {
+      std::uint64_t p0 = static_cast<std::uint64_t>(kMultiplier0) * c0;
+      std::uint64_t p1 = static_cast<std::uint64_t>(kMultiplier1) * c2;
+      c0 = high(p1) ^ c1 ^ k0[round];
+      c1 = low(p1);
+      c2 = high(p0) ^ c3 ^ k1[round];
+      c3 = low(p0);
+    }
+    r0[i] = c0;
+    r1[i] = c1;
+    r2[i] = c2;
+    r3[i] = c3;
+  }
+
+  for (size_t i = 0; i < kBatchSize; ++i) {
+    out[4 * i] = r0[i];
+    out[4 * i + 1] = r1[i];
+    out[4 * i + 2] = r2[i];
+    out[4 * i + 3] = r3[i];
+  }
+}
+
+}  // namespace
+
+Philox4x32::Philox4x32(std::uint64_t seed, std::uint64_t stream) {
+  this->seed(seed, stream);
+}
+
+void Philox4x32::seed(std::uint64_t seed, std::uint64_t stream) {
+  key_[0] = low(seed);
+  key_[1] = high(seed);
+  stream_ = stream;
+  counter_ = 0;
+  index_ = 4;
+}
+
+void Philox4x32::block(const result_type counter[4], const result_type key[2],
+                       result_type out[4]) {
+  result_type c0 = counter[0], c1 = counter[1];
+  result_type c2 = counter[2], c3 = counter[3];
+  result_type k0 = key[0], k1 = key[1];
+
+  for (int round = 0; round < kRounds; ++round) {
+    std::uint64_t p0 = static_cast<std::uint64_t>(kMultiplier0) * c0;
+    std::uint64_t p1 = static_cast<std::uint64_t>(kMultiplier1) * c2;
+    c0 = high(p1) ^ c1 ^ k0;
+    c1 = low(p1);
+    c2 = high(p0) ^ c3 ^ k1;
+    c3 = low(p0);
+    k0 += kWeyl0;
+    k1 += kWeyl1;
+  }
+
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+void Philox4x32::refill() {
+  result_type counter[4] = {
+    low(counter_), high(counter_), low(stream_), high(stream_)
+  };
+  block(counter, key_, buffer_);
+  ++counter_;
+  index_ = 0;
+}
+
+void Philox4x32::discard(unsigned long long z) {
+  while ( z > 0 && index_ < 4 ) {
+    ++index_;
+    --z;
+  }
+  counter_ += z / 4;
+  if ( z % 4 != 0 ) {
+    refill();
+    index_ = static_cast<int>(z % 4);
+  }
+}
+
+void Philox4x32::generate(result_type* out, size_t n) {
+  // Numbers left from the last block
+  while ( n > 0 && index_ < 4 ) {
+    *out++ = buffer_[index_++];
+    --n;
+  }
+
+  while ( n >= 4 * kBatchSize ) {
+    batch(counter_, stream_, key_, out);
+    counter_ += kBatchSize;
+    out += 4 * kBatchSize;
+    n -= 4 * kBatchSize;
+  }
+
+  while ( n > 0 ) {
+    if ( index_ == 4 )
+      refill();
+    *out++ = buffer_[index_++];
+    --n;
+  }
+}
+
+void BoboThreadd::parallel_generate_bits(ThreadPool* pool,
+                                         std::uint32_t* first,
+                                         std::uint32_t* last,
+                                         std::uint64_t seed) {
+  size_t n = last - first;
+  size_t chunks = (n + kRandomChunkSize - 1) / kRandomChunkSize;
+  size_t count = block_count(pool, n);
+  if ( count > chunks )
+    count = (chunks > 0) ? chunks : 1;
+
+  parallel_blocks(pool, count, [&](size_t block) {
+    size_t begin = internal::block_begin(chunks, count, block);
+    size_t end = internal::block_begin(chunks, count, block + 1);
+    for (size_t chunk = begin; chunk < end; ++chunk) {
+      size_t offset = chunk * kRandomChunkSize;
+      size_t length = (n - offset < kRandomChunkSize) ? 
+        n - offset : kRandomChunkSize;
+      Philox4x32(seed, chunk).generate(first + offset, length);
+    }
+  });
+}
@@ -27,19 +27,31 @@
 using namespace BoboThreadd;
 
 ThreadPool::ThreadPool(size_t n, int dispatch_type)
-  : current_index_(0),
-    dispatch_type_(dispatch_type){ 						
+  : lane_(new BlockingLane(BlockingLane::kDefaultMaxThreads, &pending_)),
+    dispatch_type_(dispatch_type),
+    current_index_(0) { 						
   workers_.reserve(n);
   for (size_t i = 0; i < n; ++i)
-    workers_.push_back(new Worker());  
+    workers_.push_back(new Worker(i, &pending_));  
 }
 
 ThreadPool::~ThreadPool() {
   for (auto worker : workers_)
     delete worker;
+  delete lane_;
 }
 
 void ThreadPool::execute(Task* task) {
+  pending_.add();
+  try {
+    dispatch(task);
+  } catch (...) {
+    pending_.done();
+    throw;
+  }
+}
+
+void ThreadPool::dispatch(Task* task) {
   int chosen_index = -1;
 
   switch (dispatch_type_) {
@@ -65,7 +77,34 @@ void ThreadPool::execute(Task* task) {
     }
   }
 
-  workers_.at(chosen_index)->execute(task);
+  Worker* chosen = workers_.at(chosen_index);
+  if ( chosen->blocked() ) {
+    // Pick the next worker which is not in a blocking call
+    for (size_t i = 1, length = this->size(); i < length; ++i) {
+      Worker* next = workers_[(chosen_index + i) % length];
+      if ( !next->blocked() ) {
+        next->execute(task);
+        return;
+      }
+    }
+    // All the workers are blocked. Lane threads are reserved for
+    // blocking calls, so the task waits for the shortest queue.
+    for (auto worker : workers_)
+      if ( worker->size() < chosen->size() )
+        chosen = worker;
+  }
+
+  chosen->execute(task);
+}
+
+void ThreadPool::execute_blocking(Task* task) {
+  pending_.add();
+  try {
+    lane_->execute(task);
+  } catch (...) {
+    pending_.done();
+    throw;
+  }
 }
 
 void ThreadPool::interrupt() {
@@ -75,6 +114,7 @@ void ThreadPool::interrupt() {
   // Remove queued tasks
   for (auto worker : workers_)
     worker->interrupt();
+  lane_->interrupt();
 }
 
 void ThreadPool::suspend() {
@@ -87,19 +127,57 @@ void ThreadPool::start() {
     worker->start();
 }
 
-void ThreadPool::wait() {
+void ThreadPool::warm_up() {
+  // Threads touch their stacks in parallel
   for (auto worker : workers_)
-    worker->wait();
+    worker->warm_up();
+  for (auto worker : workers_)
+    worker->wait_started();
+}
+
+void ThreadPool::wait() {
+  // Checking workers one by one could miss a task moved by
+  // BlockingRegion to an already checked worker
+  pending_.wait();
 }
 
 size_t ThreadPool::size() {
   return workers_.size();
 }
 
+int ThreadPool::worker_index() {
+  Worker* current = Worker::current();
+  if ( current == nullptr )
+    return -1;
+
+  // Worker may belong to another pool
+  size_t index = current->index();
+  if ( index < workers_.size() && workers_[index] == current )
+    return static_cast<int>(index);
+  return -1;
+}
+
+ThreadPool::BlockingRegion::BlockingRegion(ThreadPool* pool)
+  : worker_(nullptr) {
+  int index = pool->worker_index();
+  if ( index < 0 )
+    return;
+
+  worker_ = pool->workers_[index];
+  worker_->block();
+  // Tasks queued behind the blocking one would wait for it
+  // ( they are counted by pending_ already )
+  for (auto task : worker_->release_tasks())
+    pool->dispatch(task);
+}
+
+ThreadPool::BlockingRegion::~BlockingRegion() {
+  if ( worker_ != nullptr )
+    worker_->unblock();
+}
+
 int ThreadPool::get_consecutive() {
-  ++current_index_; 
-  current_index_ %= this->size();
-  return current_index_;
+  return (++current_index_) % this->size();
 }
 
 int ThreadPool::get_randomized() {
@@ -156,4 +234,4 @@ int ThreadPool::get_combination() {
     }
   
   return best_index;
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -25,61 +25,140 @@
 
 using namespace BoboThreadd;
 
-Worker::Worker() 
-  : canceled_(false), 
+namespace {
+
+// Part of the stack touched by warm_up()
+const size_t kWarmUpStackSize = 256 * 1024;
+const size_t kPageSize = 4096;
+
+// Makes OS map the top of the stack before any task needs it
+char prefault_stack() {
+  volatile char stack[kWarmUpStackSize];
+  for (size_t i = 0; i < kWarmUpStackSize; i += kPageSize)
+    stack[i] = 0;
+  return stack[0];
+}
+
+}  // namespace
+
+thread_local Worker* Worker::current_ = nullptr;
+
+Worker::Worker(size_t index, TaskCounter* counter) 
+  : index_(index),
+    counter_(counter),
+    canceled_(false), 
     suspended_(true), 
     working_(false), 
+    started_(false),
+    blocked_(0),
+    thread_(nullptr),
+    tasks_(new std::queue<Task*>()),
     mutex_(new std::mutex()),
-    global_mutex_(new std::mutex()),
-    tasks_(new std::queue<Task*>())
+    state_changed_(new std::condition_variable())
 {					
-  std::thread(&Worker::working_function, this).detach();
-  mutex_->lock();
-  mutex_->unlock();
 }
 
 Worker::~Worker() {		
+  mutex_->lock();
   canceled_ = true;
-  global_mutex_->lock();
-  global_mutex_->unlock();
+  mutex_->unlock();
+  state_changed_->notify_all();
+
+  if( thread_ != nullptr ) {
+    thread_->join();
+    delete thread_;
+  }
+  delete state_changed_;
   delete mutex_;	
-  delete global_mutex_;
   delete tasks_;
 }
 
 void Worker::execute(Task* task) {
-  mutex_->lock();
-  if( !canceled_ )
+  {
+    // spawn() may throw, lock_guard unlocks mutex_ anyway
+    std::lock_guard<std::mutex> lock(*mutex_);
+    if( canceled_ )
+      return;
+    // Thread is started by the first task given to the worker.
+    // Task is queued only if the thread exists, so a failed
+    // execute() may be simply retried.
+    if( thread_ == nullptr )
+      spawn(false);
     tasks_->push(task);
-  mutex_->unlock();
+  }
+  state_changed_->notify_all();
+}
+
+void Worker::warm_up() {
+  std::lock_guard<std::mutex> lock(*mutex_);
+  if( !canceled_ && thread_ == nullptr )
+    spawn(true);
+}
+
+void Worker::wait_started() {
+  std::unique_lock<std::mutex> lock(*mutex_);
+  while( thread_ != nullptr && !started_ )
+    state_changed_->wait(lock);
 }
 
 void Worker::interrupt() {
+  size_t removed;
+
   mutex_->lock();
+  removed = tasks_->size();
   while( !tasks_->empty() ) 
     tasks_->pop();		
   mutex_->unlock();
+  state_changed_->notify_all();
+
+  if( counter_ != nullptr )
+    counter_->done(removed);
+}
+
+std::vector<Task*> Worker::release_tasks() {
+  std::vector<Task*> released;
+
+  mutex_->lock();
+  released.reserve(tasks_->size());
+  while( !tasks_->empty() ) {
+    released.push_back(tasks_->front());
+    tasks_->pop();
+  }
+  mutex_->unlock();
+  state_changed_->notify_all();
+
+  return released;
+}
+
+void Worker::block() {
+  ++blocked_;
+}
+
+void Worker::unblock() {
+  --blocked_;
+}
+
+bool Worker::blocked() {
+  return blocked_ > 0;
 }
 
 void Worker::wait() {
-  do {    
-    mutex_->lock();    
-    if( !tasks_->empty() || working_ ) {
-      mutex_->unlock();
-      std::this_thread::sleep_for( std::chrono::milliseconds(17) );
-    } else {
-      mutex_->unlock();
-      break;						
-    }
-  }	while ( true );
+  std::unique_lock<std::mutex> lock(*mutex_);
+  while( !tasks_->empty() || working_ )
+    state_changed_->wait(lock);
 }
 
 void Worker::start() {
+  mutex_->lock();
   suspended_ = false;
+  mutex_->unlock();
+  state_changed_->notify_all();
 }
 
 void Worker::suspend() {
+  mutex_->lock();
   suspended_ = true;
+  mutex_->unlock();
 }
 
 size_t Worker::size() {
@@ -92,30 +171,50 @@ size_t Worker::size() {
   return res;
 }
 
-void Worker::working_function() {
-  global_mutex_->lock();
+size_t Worker::index() {
+  return index_;
+}
+
+Worker* Worker::current() {
+  return current_;
+}
 
-  do {
-    if( suspended_ ) {
-      std::this_thread::sleep_for( std::chrono::milliseconds(10));
+// NOTE: mutex_ must be locked by the caller
+// ( thread_ stays nullptr if std::thread throws )
+void Worker::spawn(bool warm_up) {
+  thread_ = new std::thread(&Worker::working_function, this, warm_up);
+}
+
+void Worker::working_function(bool warm_up) {
+  current_ = this;
+  if( warm_up )
+    prefault_stack();
+
+  std::unique_lock<std::mutex> lock(*mutex_);
+  started_ = true;
+  state_changed_->notify_all();
+
+  while( !canceled_ ) {
+    if( suspended_ || tasks_->empty() ) {
+      // start(), execute() and destructor wake the thread up
+      state_changed_->wait(lock);
     } else {
-      mutex_->lock();
-      if( !tasks_->empty() ) {		
-
-        Task* current_task = tasks_->front();
-        tasks_->pop();  // pointer Task* cannot be destroyed by pop()
-        mutex_->unlock();
-
-        // work() doesn't require synchronization
-        working_ = true;
-        current_task->work();
-        working_ = false;
-      } else {
-        mutex_->unlock();
-        std::this_thread::sleep_for( std::chrono::milliseconds(10));
-      }		
+      Task* current_task = tasks_->front();
+      tasks_->pop();  // pointer Task* cannot be destroyed by pop()
+      // set under the lock, so wait() never sees an empty queue
+      // while the task is not started yet
+      working_ = true;
+      lock.unlock();
+
+      // work() doesn't require synchronization
+      current_task->work();
+      if( counter_ != nullptr )
+        counter_->done();
+
+      lock.lock();
+      working_ = false;
+      if( tasks_->empty() )
+        state_changed_->notify_all();  // for wait()
     }
-  } while( !canceled_ );
-
-  global_mutex_->unlock();
-}
\ No newline at end of file
+  }
+}